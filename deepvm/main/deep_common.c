@@ -6,15 +6,18 @@ Date: 2020/11/10
 Description: deep common functions
 */
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdarg.h>
 #include <string.h>
 #include "driver/uart.h"
 #include "driver/gpio.h"
 #include "deep_common.h"
+#include "deep_trace.h"
 
 #define LINE_MAX (120)
 void deep_send_buf (const char * buffer, int len) {
-    return uart_write_bytes(UART_NUM_0, buffer, len);
+    deep_trace_record (DEEP_TRACE_TX, (const unsigned char *) buffer, len);
+    uart_write_bytes(UART_NUM_0, buffer, len);
 }
 
 void deep_printf (const char *format, ...)
@@ -24,6 +27,10 @@ void deep_printf (const char *format, ...)
 	va_start(arg, format);
     int len = vsnprintf(buffer, LINE_MAX, format, arg); 
 	va_end(arg);
+    if (len >= LINE_MAX) {
+        len = LINE_MAX - 1;
+    }
+    deep_trace_record (DEEP_TRACE_TX, (const unsigned char *) buffer, len);
     uart_write_bytes(UART_NUM_0, (const char *) buffer, len);
 }
 
@@ -0,0 +1,366 @@
+/*
+Date: 2026/10/19
+Description: deepvm event manager
+             timer wheel: level n slot covers 64^n ticks, timers cascade down
+             one level when the lower level wraps, so start/stop are O(1)
+             and each tick only touches one slot of level 0.
+*/
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "deep_common.h"
+#include "dstp.h"
+#include "deep_event.h"
+
+#define WHEEL_LEVELS     4
+#define WHEEL_BITS       6
+#define WHEEL_SLOTS      (1 << WHEEL_BITS)
+#define WHEEL_MASK       (WHEEL_SLOTS - 1)
+#define WHEEL_MAX_DELAY  ((1u << (WHEEL_LEVELS * WHEEL_BITS)) - 1)
+#define EVENT_BATCH      (32)    /* max ready events per queue per pass */
+
+typedef struct deep_wheel {
+    unsigned int now;
+    deep_list_t slot[WHEEL_LEVELS][WHEEL_SLOTS];
+    deep_list_t expired;
+} deep_wheel_t;
+
+static deep_wheel_t EventWheel;
+static deep_list_t ReadyQueue[DEEP_EVENT_QUEUE_MAX];
+static portMUX_TYPE EventLock = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t EventTask = NULL;   /* task running deep_event_process */
+
+static void list_init (deep_list_t *head) {
+    head->next = head;
+    head->prev = head;
+}
+
+static bool list_empty (deep_list_t *head) {
+    return head->next == head;
+}
+
+static void list_add_tail (deep_list_t *head, deep_list_t *node) {
+    node->prev = head->prev;
+    node->next = head;
+    head->prev->next = node;
+    head->prev = node;
+}
+
+static void list_del (deep_list_t *node) {
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+    node->next = node;
+    node->prev = node;
+}
+
+/* move all nodes of src to the tail of dst, src becomes empty */
+static void list_splice (deep_list_t *dst, deep_list_t *src) {
+    if (list_empty (src)) {
+        return;
+    }
+    src->next->prev = dst->prev;
+    dst->prev->next = src->next;
+    src->prev->next = dst;
+    dst->prev = src->prev;
+    list_init (src);
+}
+
+static deep_event_t *list_pop (deep_list_t *head) {
+    if (list_empty (head)) {
+        return NULL;
+    }
+    deep_list_t *node = head->next;
+    list_del (node);
+    return (deep_event_t *) node;
+}
+
+static void wheel_init (deep_wheel_t *wheel, unsigned int now) {
+    wheel->now = now;
+    for (int level = 0; level < WHEEL_LEVELS; level++) {
+        for (int i = 0; i < WHEEL_SLOTS; i++) {
+            list_init (&wheel->slot[level][i]);
+        }
+    }
+    list_init (&wheel->expired);
+}
+
+static void wheel_add (deep_wheel_t *wheel, deep_event_t *ev) {
+    unsigned int delta = ev->expire - wheel->now;
+    if (delta == 0 || delta > 0x7FFFFFFF) {
+        /* already due */
+        list_add_tail (&wheel->expired, &ev->link);
+        return;
+    }
+    unsigned int expire = ev->expire;
+    if (delta > WHEEL_MAX_DELAY) {
+        /* park in the top level, it is re-hashed on cascade */
+        expire = wheel->now + WHEEL_MAX_DELAY;
+        delta = WHEEL_MAX_DELAY;
+    }
+    int level = 0;
+    while (level < WHEEL_LEVELS - 1 && delta >= (1u << ((level + 1) * WHEEL_BITS))) {
+        level++;
+    }
+    int index = (expire >> (level * WHEEL_BITS)) & WHEEL_MASK;
+    list_add_tail (&wheel->slot[level][index], &ev->link);
+}
+
+/* re-hash one slot of a higher level, return that slot index */
+static int wheel_cascade (deep_wheel_t *wheel, int level) {
+    int index = (wheel->now >> (level * WHEEL_BITS)) & WHEEL_MASK;
+    deep_list_t list;
+    list_init (&list);
+    list_splice (&list, &wheel->slot[level][index]);
+    deep_event_t *ev = NULL;
+    while ((ev = list_pop (&list)) != NULL) {
+        wheel_add (wheel, ev);
+    }
+    return index;
+}
+
+/* advance one tick, due timers are moved to wheel->expired */
+static void wheel_step (deep_wheel_t *wheel) {
+    wheel->now++;
+    int index = wheel->now & WHEEL_MASK;
+    if (index == 0) {
+        for (int level = 1; level < WHEEL_LEVELS; level++) {
+            if (wheel_cascade (wheel, level) != 0) {
+                break;
+            }
+        }
+    }
+    list_splice (&wheel->expired, &wheel->slot[0][index]);
+}
+
+/*
+ * ticks from wheel->now to the next tick with work: a due level 0 slot or a
+ * cascade of a non-empty higher level slot. portMAX_DELAY if the wheel is empty.
+ */
+static unsigned int wheel_next (deep_wheel_t *wheel) {
+    if (!list_empty (&wheel->expired)) {
+        return 0;
+    }
+    unsigned int next = portMAX_DELAY;
+    for (int level = 0; level < WHEEL_LEVELS; level++) {
+        int shift = level * WHEEL_BITS;
+        unsigned int pos = wheel->now >> shift;
+        for (unsigned int i = 1; i <= WHEEL_SLOTS; i++) {
+            if (!list_empty (&wheel->slot[level][(pos + i) & WHEEL_MASK])) {
+                unsigned int delta = ((pos + i) << shift) - wheel->now;
+                if (delta < next) {
+                    next = delta;
+                }
+                break;
+            }
+        }
+    }
+    return next;
+}
+
+static void event_wake (void) {
+    if (EventTask != NULL) {
+        xTaskNotifyGive (EventTask);
+    }
+}
+
+void deep_event_init (void) {
+    portENTER_CRITICAL (&EventLock);
+    wheel_init (&EventWheel, xTaskGetTickCount ());
+    for (int q = 0; q < DEEP_EVENT_QUEUE_MAX; q++) {
+        list_init (&ReadyQueue[q]);
+    }
+    portEXIT_CRITICAL (&EventLock);
+}
+
+/*
+ * delay and period are in FreeRTOS ticks, period 0 is one-shot.
+ * an armed timer is restarted, an event waiting in a ready queue is refused.
+ */
+int deep_event_timer_start (deep_event_t *ev, unsigned int delay, unsigned int period, deep_event_cb_t cb, void *arg) {
+    if (ev == NULL) {
+        return DEEP_FAIL;
+    }
+    portENTER_CRITICAL (&EventLock);
+    if (ev->state == DEEP_EVENT_READY) {
+        portEXIT_CRITICAL (&EventLock);
+        return DEEP_FAIL;
+    }
+    if (ev->state == DEEP_EVENT_TIMER) {
+        list_del (&ev->link);
+    }
+    /* the wheel may lag behind while the event task is busy */
+    ev->expire = xTaskGetTickCount () + delay;
+    ev->period = period;
+    ev->cb = cb;
+    ev->arg = arg;
+    ev->state = DEEP_EVENT_TIMER;
+    wheel_add (&EventWheel, ev);
+    portEXIT_CRITICAL (&EventLock);
+    event_wake ();
+    return DEEP_OK;
+}
+
+void deep_event_timer_stop (deep_event_t *ev) {
+    if (ev == NULL) {
+        return;
+    }
+    portENTER_CRITICAL (&EventLock);
+    if (ev->state == DEEP_EVENT_TIMER) {
+        list_del (&ev->link);
+        ev->state = DEEP_EVENT_IDLE;
+    }
+    portEXIT_CRITICAL (&EventLock);
+}
+
+int deep_event_post (int queue, deep_event_t *ev, deep_event_cb_t cb, void *arg) {
+    if (ev == NULL || queue < 0 || queue >= DEEP_EVENT_QUEUE_MAX) {
+        return DEEP_FAIL;
+    }
+    portENTER_CRITICAL (&EventLock);
+    if (ev->state != DEEP_EVENT_IDLE) {
+        portEXIT_CRITICAL (&EventLock);
+        return DEEP_FAIL;
+    }
+    ev->cb = cb;
+    ev->arg = arg;
+    ev->state = DEEP_EVENT_READY;
+    list_add_tail (&ReadyQueue[queue], &ev->link);
+    portEXIT_CRITICAL (&EventLock);
+    event_wake ();
+    return DEEP_OK;
+}
+
+/*
+ * run ready events and all timers due up to the current tick, return event count.
+ * blocks before returning: one tick after work so lower priority tasks get to
+ * run under load, otherwise until a post or the next tick the wheel has work
+ * for (forever if no timer is armed, not at all if a timer is already due).
+ * an event is unlinked, copied and re-armed in one critical section, so it can
+ * be restarted, stopped or posted again from its callback or another core.
+ */
+int deep_event_process (void) {
+    int done = 0;
+    deep_event_t *ev = NULL;
+    deep_event_cb_t cb = NULL;
+    void *arg = NULL;
+    if (EventTask == NULL) {
+        EventTask = xTaskGetCurrentTaskHandle ();
+    }
+    for (int q = 0; q < DEEP_EVENT_QUEUE_MAX; q++) {
+        for (int i = 0; i < EVENT_BATCH; i++) {
+            portENTER_CRITICAL (&EventLock);
+            ev = list_pop (&ReadyQueue[q]);
+            if (ev != NULL) {
+                cb = ev->cb;
+                arg = ev->arg;
+                ev->state = DEEP_EVENT_IDLE;
+            }
+            portEXIT_CRITICAL (&EventLock);
+            if (ev == NULL) {
+                break;
+            }
+            if (cb != NULL) {
+                cb (arg);
+            }
+            done++;
+        }
+    }
+    unsigned int now = xTaskGetTickCount ();
+    while (EventWheel.now != now) {
+        portENTER_CRITICAL (&EventLock);
+        wheel_step (&EventWheel);
+        portEXIT_CRITICAL (&EventLock);
+    }
+    while (1) {
+        portENTER_CRITICAL (&EventLock);
+        ev = list_pop (&EventWheel.expired);
+        if (ev != NULL) {
+            cb = ev->cb;
+            arg = ev->arg;
+            if (ev->period != 0) {
+                ev->expire += ev->period;
+                wheel_add (&EventWheel, ev);
+            } else {
+                ev->state = DEEP_EVENT_IDLE;
+            }
+        }
+        portEXIT_CRITICAL (&EventLock);
+        if (ev == NULL) {
+            break;
+        }
+        if (cb != NULL) {
+            cb (arg);
+        }
+        done++;
+    }
+    if (done > 0) {
+        vTaskDelay (1);
+        return done;
+    }
+    portENTER_CRITICAL (&EventLock);
+    unsigned int wait = wheel_next (&EventWheel);
+    unsigned int late = xTaskGetTickCount () - EventWheel.now;
+    portEXIT_CRITICAL (&EventLock);
+    if (wait != portMAX_DELAY) {
+        wait = (wait > late) ? wait - late : 0;
+    }
+    if (wait > 0) {
+        ulTaskNotifyTake (pdTRUE, wait);
+    }
+    return done;
+}
+
+static void bench_cb (void *arg) {
+    (*(int *) arg)++;
+}
+
+/* insert, cancel and expire count timers on a private wheel driven by a fake clock */
+void deep_event_bench (int count) {
+    deep_wheel_t *wheel = deep_malloc (sizeof (deep_wheel_t));
+    deep_event_t *evs = deep_malloc (count * sizeof (deep_event_t));
+    if (wheel == NULL || evs == NULL) {
+        deep_printf ("event bench: no memory for %d timers\r\n", count);
+        deep_free (wheel);
+        deep_free (evs);
+        return;
+    }
+    int fired = 0;
+    unsigned int seed = 1;
+    unsigned int last = 0;
+    wheel_init (wheel, 0);
+    int64_t t0 = esp_timer_get_time ();
+    for (int i = 0; i < count; i++) {
+        seed = seed * 1103515245 + 12345;
+        evs[i].expire = 1 + (seed >> 16) % 10000;
+        evs[i].period = 0;
+        evs[i].cb = bench_cb;
+        evs[i].arg = &fired;
+        evs[i].state = DEEP_EVENT_TIMER;
+        wheel_add (wheel, &evs[i]);
+        if (evs[i].expire > last) {
+            last = evs[i].expire;
+        }
+    }
+    int64_t t1 = esp_timer_get_time ();
+    for (int i = 0; i < count; i += 2) {
+        list_del (&evs[i].link);
+        evs[i].state = DEEP_EVENT_IDLE;
+    }
+    int64_t t2 = esp_timer_get_time ();
+    deep_event_t *ev = NULL;
+    while (wheel->now != last) {
+        wheel_step (wheel);
+        while ((ev = list_pop (&wheel->expired)) != NULL) {
+            ev->state = DEEP_EVENT_IDLE;
+            ev->cb (ev->arg);
+        }
+    }
+    int64_t t3 = esp_timer_get_time ();
+    deep_printf ("event bench: %d timers, insert %d us, cancel %d us, expire %d us over %d ticks, fired %d\r\n",
+                 count, (int) (t1 - t0), (int) (t2 - t1), (int) (t3 - t2), last, fired);
+    deep_free (evs);
+    deep_free (wheel);
+}
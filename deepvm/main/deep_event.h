@@ -0,0 +1,44 @@
+/*
+Date: 2026/10/19
+Description: deepvm event manager
+             hierarchical timer wheel (4 levels x 64 slots, O(1) start/stop)
+             ready queues for uart, storage and vm callbacks
+             events are owned by the caller, nothing is allocated per event
+*/
+
+#ifndef _DEEP_EVENT_H
+#define _DEEP_EVENT_H
+
+#define DEEP_EVENT_QUEUE_UART     0
+#define DEEP_EVENT_QUEUE_STORAGE  1
+#define DEEP_EVENT_QUEUE_VM       2
+#define DEEP_EVENT_QUEUE_MAX      3
+
+#define DEEP_EVENT_IDLE      0x00
+#define DEEP_EVENT_TIMER     0x01   /* armed in timer wheel */
+#define DEEP_EVENT_READY     0x02   /* waiting in a ready queue */
+
+typedef void (*deep_event_cb_t) (void *arg);
+
+typedef struct deep_list {
+    struct deep_list *next;
+    struct deep_list *prev;
+} deep_list_t;
+
+typedef struct deep_event {
+    deep_list_t link;       /* must be first */
+    unsigned int expire;    /* absolute tick */
+    unsigned int period;    /* 0 for one-shot timer */
+    deep_event_cb_t cb;
+    void *arg;
+    int state;
+} deep_event_t;
+
+void deep_event_init (void);
+int deep_event_timer_start (deep_event_t *ev, unsigned int delay, unsigned int period, deep_event_cb_t cb, void *arg);
+void deep_event_timer_stop (deep_event_t *ev);
+int deep_event_post (int queue, deep_event_t *ev, deep_event_cb_t cb, void *arg);
+int deep_event_process (void);
+void deep_event_bench (int count);
+
+#endif
@@ -0,0 +1,668 @@
+/*
+Date: 2026/10/19
+Description: deeplang repl session
+             names are interned (hash -> symbol id) when a definition names or
+             uses them, so resolving a line costs one probe per identifier no
+             matter how many definitions exist. expressions only look names
+             up. dependency edges are tagged with the dependent's version, a
+             recompile bumps the version and old edges die lazily.
+*/
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+#include "deep_common.h"
+#include "dstp.h"
+#include "deep_repl.h"
+
+#define HASH_SIZE      (DEEP_SYM_MAX * 2)
+#define LOCAL_MAX      (32)    /* a repl line is at most 119 characters */
+
+static deep_repl_session_t Session;
+static SemaphoreHandle_t SessionLock = NULL;   /* repl task vs snapshot timer */
+
+static const char *Keywords[] = {
+    "let", "mut", "fun", "if", "else", "while", "for", "in", "return",
+    "break", "continue", "match", "as", "type", "interface", "impl",
+    "true", "false", "null", "this",
+    "i8", "i16", "i32", "i64", "u8", "u16", "u32", "u64",
+    "f32", "f64", "bool", "char", "string", "void",
+};
+
+static bool is_ident_start (char ch) {
+    return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || ch == '_';
+}
+
+static bool is_ident_char (char ch) {
+    return is_ident_start (ch) || (ch >= '0' && ch <= '9');
+}
+
+/*
+ * return next identifier in *p and its length, NULL at end of line.
+ * string and char literals, comments and member names (a.b) are skipped.
+ */
+static const char *next_ident (const char **p, int *len) {
+    const char *s = *p;
+    while (*s != '\0') {
+        if (is_ident_start (*s)) {
+            const char *start = s;
+            while (is_ident_char (*s)) {
+                s++;
+            }
+            *len = s - start;
+            *p = s;
+            return start;
+        }
+        if (*s >= '0' && *s <= '9') {
+            while (is_ident_char (*s)) {
+                s++;
+            }
+        } else if (*s == '"' || *s == '\'') {
+            char quote = *s++;
+            while (*s != '\0' && *s != quote) {
+                if (*s == '\\' && *(s + 1) != '\0') {
+                    s++;
+                }
+                s++;
+            }
+            if (*s == quote) {
+                s++;
+            }
+        } else if (*s == '.' && *(s + 1) == '.') {
+            /* range operator */
+            s += 2;
+        } else if (*s == '.') {
+            s++;
+            while (*s == ' ' || *s == '\t') {
+                s++;
+            }
+            while (is_ident_char (*s)) {
+                s++;
+            }
+        } else if (*s == '/' && *(s + 1) == '/') {
+            break;
+        } else {
+            s++;
+        }
+    }
+    *p = s;
+    return NULL;
+}
+
+static unsigned int sym_hash (const char *name, int len) {
+    unsigned int h = 2166136261u;
+    for (int i = 0; i < len; i++) {
+        h ^= (unsigned char) name[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/* return the hash slot holding name, or the empty slot it would go to */
+static unsigned int sym_probe (const char *name, int len) {
+    unsigned int index = sym_hash (name, len) & (HASH_SIZE - 1);
+    while (Session.hash[index] >= 0) {
+        const char *known = Session.sym[Session.hash[index]].name;
+        if (strncmp (known, name, len) == 0 && known[len] == '\0') {
+            break;
+        }
+        index = (index + 1) & (HASH_SIZE - 1);
+    }
+    return index;
+}
+
+/* return symbol id of name, -1 if it was never interned */
+static int sym_lookup (const char *name, int len) {
+    return Session.hash[sym_probe (name, len)];
+}
+
+/* return symbol id of name, add it if new, -1 if table is full */
+static int sym_intern (const char *name, int len) {
+    unsigned int index = sym_probe (name, len);
+    if (Session.hash[index] >= 0) {
+        return Session.hash[index];
+    }
+    if (Session.sym_count >= DEEP_SYM_MAX || Session.names_used + len + 1 > DEEP_SYM_NAME_POOL) {
+        return -1;
+    }
+    char *copy = &Session.names[Session.names_used];
+    memcpy (copy, name, len);
+    copy[len] = '\0';
+    Session.names_used += len + 1;
+    int id = Session.sym_count++;
+    deep_symbol_t *sym = &Session.sym[id];
+    sym->name = copy;
+    sym->source = NULL;
+    sym->dependents = -1;
+    sym->missing = -1;
+    sym->version = 0;
+    sym->state = DEEP_SYM_UNDEF;
+    Session.hash[index] = id;
+    return id;
+}
+
+static bool edge_dead (deep_sym_edge_t *edge) {
+    return edge->version != Session.sym[edge->sym].version;
+}
+
+/* drop edges whose dependent was recompiled since */
+static void edge_sweep (void) {
+    for (int id = 0; id < Session.sym_count; id++) {
+        short *link = &Session.sym[id].dependents;
+        while (*link >= 0) {
+            short e = *link;
+            if (edge_dead (&Session.edge[e])) {
+                *link = Session.edge[e].next;
+                Session.edge[e].next = Session.edge_free;
+                Session.edge_free = e;
+            } else {
+                link = &Session.edge[e].next;
+            }
+        }
+    }
+}
+
+/* record that dependent uses dependency */
+static int edge_add (int dependency, int dependent) {
+    deep_symbol_t *sym = &Session.sym[dependency];
+    short head = sym->dependents;
+    if (head >= 0 && Session.edge[head].sym == dependent
+        && Session.edge[head].version == Session.sym[dependent].version) {
+        return DEEP_OK;
+    }
+    if (Session.edge_free < 0) {
+        edge_sweep ();
+        if (Session.edge_free < 0) {
+            return DEEP_FAIL;
+        }
+    }
+    short e = Session.edge_free;
+    Session.edge_free = Session.edge[e].next;
+    Session.edge[e].sym = dependent;
+    Session.edge[e].version = Session.sym[dependent].version;
+    Session.edge[e].next = sym->dependents;
+    sym->dependents = e;
+    return DEEP_OK;
+}
+
+/* mark everything depending on id stale, return number of invalidated symbols */
+static int sym_invalidate (int id) {
+    static short stack[DEEP_SYM_MAX + 1];
+    int top = 0;
+    int count = 0;
+    stack[top++] = id;
+    while (top > 0) {
+        short *link = &Session.sym[stack[--top]].dependents;
+        while (*link >= 0) {
+            short e = *link;
+            deep_sym_edge_t *edge = &Session.edge[e];
+            if (edge_dead (edge)) {
+                *link = edge->next;
+                edge->next = Session.edge_free;
+                Session.edge_free = e;
+                continue;
+            }
+            deep_symbol_t *dep = &Session.sym[edge->sym];
+            if (dep->state == DEEP_SYM_VALID) {
+                dep->state = DEEP_SYM_STALE;
+                stack[top++] = edge->sym;
+                count++;
+            }
+            link = &edge->next;
+        }
+    }
+    return count;
+}
+
+/* first undefined symbol reachable from id, -1 if none */
+static int sym_missing (int id) {
+    deep_symbol_t *sym = &Session.sym[id];
+    if (sym->state == DEEP_SYM_UNDEF) {
+        return id;
+    }
+    /* a missing symbol defined since is cleared by the recompile its definition forces */
+    if (sym->missing >= 0 && Session.sym[sym->missing].state != DEEP_SYM_UNDEF) {
+        return -1;
+    }
+    return sym->missing;
+}
+
+/* pass the missing symbol of id on to everything depending on it (cycles included) */
+static void sym_propagate_missing (int id) {
+    static short stack[DEEP_SYM_MAX + 1];
+    int top = 0;
+    short missing = Session.sym[id].missing;
+    stack[top++] = id;
+    while (top > 0) {
+        for (short e = Session.sym[stack[--top]].dependents; e >= 0; e = Session.edge[e].next) {
+            deep_sym_edge_t *edge = &Session.edge[e];
+            if (edge_dead (edge) || sym_missing (edge->sym) >= 0) {
+                continue;
+            }
+            Session.sym[edge->sym].missing = missing;
+            stack[top++] = edge->sym;
+        }
+    }
+}
+
+typedef struct repl_locals {
+    const char *name[LOCAL_MAX];
+    int len[LOCAL_MAX];
+    int count;
+} repl_locals_t;
+
+static bool is_word (const char *name, int len, const char *word) {
+    return len == (int) strlen (word) && memcmp (name, word, len) == 0;
+}
+
+static void local_add (repl_locals_t *locals, const char *name, int len) {
+    if (locals->count < LOCAL_MAX) {
+        locals->name[locals->count] = name;
+        locals->len[locals->count++] = len;
+    }
+}
+
+static bool local_has (repl_locals_t *locals, const char *name, int len) {
+    for (int i = 0; i < locals->count; i++) {
+        if (locals->len[i] == len && memcmp (locals->name[i], name, len) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* add the identifiers of source between from and to */
+static void local_add_range (repl_locals_t *locals, const char *from, const char *to) {
+    const char *name = NULL;
+    int len = 0;
+    while ((name = next_ident (&from, &len)) != NULL && name < to) {
+        local_add (locals, name, len);
+    }
+}
+
+/*
+ * collect the names source binds for itself: function and lambda parameters
+ * and let/mut/for/fun names. they are matched by text for the whole line and
+ * never enter the symbol table. scoping is not tracked, a local shadowing a
+ * session name only hides that dependency.
+ */
+static void locals_scan (repl_locals_t *locals, const char *source) {
+    const char *p = source;
+    const char *name = NULL;
+    const char *prev = NULL;
+    int prev_len = 0;
+    int len = 0;
+    locals->count = 0;
+    while ((name = next_ident (&p, &len)) != NULL) {
+        if (prev != NULL && (is_word (prev, prev_len, "let") || is_word (prev, prev_len, "mut")
+                             || is_word (prev, prev_len, "for"))) {
+            local_add (locals, name, len);
+        } else if (prev != NULL && is_word (prev, prev_len, "fun")) {
+            /* fun name(params) */
+            local_add (locals, name, len);
+            const char *open = p;
+            while (*open == ' ' || *open == '\t') {
+                open++;
+            }
+            const char *close = (*open == '(') ? strchr (open, ')') : NULL;
+            if (close != NULL) {
+                local_add_range (locals, open, close);
+            }
+        }
+        prev = name;
+        prev_len = len;
+    }
+    /* lambdas: x => ..., (x, y) => ... */
+    for (const char *arrow = strstr (source, "=>"); arrow != NULL; arrow = strstr (arrow + 2, "=>")) {
+        const char *end = arrow;
+        while (end > source && (*(end - 1) == ' ' || *(end - 1) == '\t')) {
+            end--;
+        }
+        const char *start = end;
+        if (start > source && *(start - 1) == ')') {
+            start--;
+            while (start > source && *start != '(') {
+                start--;
+            }
+        } else {
+            while (start > source && is_ident_char (*(start - 1))) {
+                start--;
+            }
+        }
+        local_add_range (locals, start, end);
+    }
+}
+
+/* name is in a type position (x: T, -> T), it may be a type the session does not know */
+static bool ident_is_type (const char *source, const char *name) {
+    while (name > source && (*(name - 1) == ' ' || *(name - 1) == '\t')) {
+        name--;
+    }
+    if (name == source) {
+        return false;
+    }
+    return *(name - 1) == ':' || (*(name - 1) == '>' && name - 1 > source && *(name - 2) == '-');
+}
+
+/*
+ * resolve every identifier of source against the session.
+ * self is the symbol being defined (-1 for an expression), names the
+ * line binds itself (see locals_scan) do not create dependencies.
+ * a definition may use undefined symbols, the first one it reaches
+ * (directly or through other definitions) is kept in missing and an
+ * expression using it fails. a name the lexer cannot place (a type)
+ * is only resolved when the session defines it.
+ */
+static int sym_compile (int self, const char *source) {
+    static repl_locals_t locals;
+    const char *p = source;
+    const char *name = NULL;
+    int len = 0;
+    locals_scan (&locals, source);
+    if (self >= 0) {
+        Session.sym[self].missing = -1;
+    }
+    while ((name = next_ident (&p, &len)) != NULL) {
+        if (local_has (&locals, name, len)) {
+            continue;
+        }
+        if (ident_is_type (source, name)) {
+            int id = sym_lookup (name, len);
+            if (id < 0 || Session.sym[id].state == DEEP_SYM_UNDEF) {
+                continue;
+            }
+        }
+        /* only definitions add names, an expression must not grow the table */
+        int id = (self >= 0) ? sym_intern (name, len) : sym_lookup (name, len);
+        if (id < 0 && self >= 0) {
+            deep_printf ("symbol table full\r\n");
+            return DEEP_FAIL;
+        }
+        if (id < 0) {
+            deep_printf ("unresolved symbol: %.*s\r\n", len, name);
+            return DEEP_FAIL;
+        }
+        deep_symbol_t *sym = &Session.sym[id];
+        if (id == self || sym->state == DEEP_SYM_KEYWORD) {
+            continue;
+        }
+        int missing = sym_missing (id);
+        if (self < 0) {
+            if (missing == id) {
+                deep_printf ("unresolved symbol: %s\r\n", sym->name);
+                return DEEP_FAIL;
+            }
+            if (missing >= 0) {
+                deep_printf ("unresolved symbol: %s (used by %s)\r\n", Session.sym[missing].name, sym->name);
+                return DEEP_FAIL;
+            }
+            continue;
+        }
+        if (edge_add (id, self) != DEEP_OK) {
+            deep_printf ("dependency table full\r\n");
+            return DEEP_FAIL;
+        }
+        if (missing >= 0 && Session.sym[self].missing < 0) {
+            Session.sym[self].missing = missing;
+        }
+    }
+    if (self >= 0 && Session.sym[self].missing >= 0) {
+        sym_propagate_missing (self);
+    }
+    return DEEP_OK;
+}
+
+/* return the first stale symbol used by source, -1 if none */
+static int sym_first_stale (const char *source) {
+    const char *p = source;
+    const char *name = NULL;
+    int len = 0;
+    while ((name = next_ident (&p, &len)) != NULL) {
+        int id = sym_lookup (name, len);
+        if (id >= 0 && Session.sym[id].state == DEEP_SYM_STALE) {
+            return id;
+        }
+    }
+    return -1;
+}
+
+/* recompile the stale symbols source depends on, dependencies first */
+static int sym_refresh (const char *source) {
+    static short stack[DEEP_SYM_MAX];
+    int top = 0;
+    while (1) {
+        const char *text = (top == 0) ? source : Session.sym[stack[top - 1]].source;
+        int id = sym_first_stale (text);
+        if (id >= 0) {
+            Session.sym[id].state = DEEP_SYM_BUSY;
+            stack[top++] = id;
+            continue;
+        }
+        if (top == 0) {
+            return DEEP_OK;
+        }
+        deep_symbol_t *sym = &Session.sym[stack[--top]];
+        sym->version++;
+        sym->state = DEEP_SYM_VALID;
+        if (sym_compile (stack[top], sym->source) != DEEP_OK) {
+            sym->state = DEEP_SYM_STALE;
+            while (top > 0) {
+                Session.sym[stack[--top]].state = DEEP_SYM_STALE;
+            }
+            return DEEP_FAIL;
+        }
+    }
+}
+
+static void repl_lock (void) {
+    if (SessionLock == NULL) {
+        deep_repl_init ();
+    }
+    xSemaphoreTake (SessionLock, portMAX_DELAY);
+}
+
+static void repl_unlock (void) {
+    xSemaphoreGive (SessionLock);
+}
+
+/* quiet is used on snapshot restore: no output, definition stays clean */
+static int repl_define (const char *line, bool quiet) {
+    const char *p = line;
+    int len = 0;
+    next_ident (&p, &len);
+    const char *name = next_ident (&p, &len);
+    if (name != NULL && len == 3 && memcmp (name, "mut", 3) == 0) {
+        name = next_ident (&p, &len);
+    }
+    if (name == NULL) {
+        deep_printf ("missing name in definition\r\n");
+        return DEEP_FAIL;
+    }
+    int id = sym_intern (name, len);
+    if (id < 0) {
+        deep_printf ("symbol table full\r\n");
+        return DEEP_FAIL;
+    }
+    deep_symbol_t *sym = &Session.sym[id];
+    if (sym->state == DEEP_SYM_KEYWORD) {
+        deep_printf ("%s is a keyword\r\n", sym->name);
+        return DEEP_FAIL;
+    }
+    char *source = deep_malloc (strlen (line) + 1);
+    if (source == NULL) {
+        deep_printf ("no memory for %s\r\n", sym->name);
+        return DEEP_FAIL;
+    }
+    strcpy (source, line);
+    /* also on a first definition: dependents may have recorded the name as missing */
+    int invalidated = sym_invalidate (id);
+    bool redefined = (sym->source != NULL);
+    if (redefined) {
+        deep_free (sym->source);
+    } else {
+        Session.defs++;
+    }
+    sym->source = source;
+    sym->missing = -1;
+    sym->version++;
+    sym->state = DEEP_SYM_VALID;
+    if (!quiet && !sym->dirty) {
+        sym->dirty = 1;
+        Session.dirty++;
+    }
+    if (sym_refresh (source) != DEEP_OK || sym_compile (id, source) != DEEP_OK) {
+        sym->state = DEEP_SYM_STALE;
+        return DEEP_FAIL;
+    }
+    if (quiet) {
+        return DEEP_OK;
+    }
+    if (redefined) {
+        deep_printf ("%s redefined, %d dependents invalidated\r\n", sym->name, invalidated);
+    } else {
+        deep_printf ("%s defined\r\n", sym->name);
+    }
+    return DEEP_OK;
+}
+
+void deep_repl_init (void) {
+    for (int id = 0; id < Session.sym_count; id++) {
+        deep_free (Session.sym[id].source);
+    }
+    memset (&Session, 0x00, sizeof (Session));
+    memset (Session.hash, 0xFF, sizeof (Session.hash));
+    if (SessionLock == NULL) {
+        SessionLock = xSemaphoreCreateMutex ();
+    }
+    for (int e = 0; e < DEEP_SYM_EDGE_MAX; e++) {
+        Session.edge[e].next = (e + 1 < DEEP_SYM_EDGE_MAX) ? e + 1 : -1;
+    }
+    Session.edge_free = 0;
+    for (int i = 0; i < (int) (sizeof (Keywords) / sizeof (Keywords[0])); i++) {
+        int id = sym_intern (Keywords[i], strlen (Keywords[i]));
+        Session.sym[id].state = DEEP_SYM_KEYWORD;
+    }
+}
+
+/* compile one repl line in the session, definitions stay resident */
+int deep_repl_eval (const char *line) {
+    if (line == NULL) {
+        return DEEP_FAIL;
+    }
+    while (*line == ' ' || *line == '\t') {
+        line++;
+    }
+    if (*line == '\0') {
+        return DEEP_OK;
+    }
+    repl_lock ();
+    int64_t start = esp_timer_get_time ();
+    int ret = DEEP_OK;
+    const char *p = line;
+    int len = 0;
+    const char *word = next_ident (&p, &len);
+    if (word == line && len == 3 && (memcmp (word, "let", 3) == 0 || memcmp (word, "fun", 3) == 0)) {
+        ret = repl_define (line, false);
+    } else {
+        ret = sym_refresh (line);
+        if (ret == DEEP_OK) {
+            ret = sym_compile (-1, line);
+        }
+        if (ret == DEEP_OK) {
+            deep_printf ("deep_eval (\"%s\")\r\n", line);
+        }
+    }
+    Session.last_us = (int) (esp_timer_get_time () - start);
+    if (Session.last_us > Session.max_us) {
+        Session.max_us = Session.last_us;
+    }
+    repl_unlock ();
+    return ret;
+}
+
+void deep_repl_stat (void) {
+    repl_lock ();
+    int stale = 0;
+    for (int id = 0; id < Session.sym_count; id++) {
+        if (Session.sym[id].state == DEEP_SYM_STALE) {
+            stale++;
+        }
+    }
+    deep_printf ("symbols %d/%d, definitions %d, stale %d, names %d/%d bytes\r\n",
+                 Session.sym_count, DEEP_SYM_MAX, Session.defs, stale, Session.names_used, DEEP_SYM_NAME_POOL);
+    deep_printf ("compile last %d us, max %d us\r\n", Session.last_us, Session.max_us);
+    repl_unlock ();
+}
+
+/* number of definitions changed since they were last saved */
+int deep_repl_dirty (void) {
+    return Session.dirty;
+}
+
+/* fill defs with every (or every dirty) definition, return how many */
+int deep_repl_list_defs (int dirty_only, deep_repl_def_t *defs, int max) {
+    int count = 0;
+    repl_lock ();
+    for (int id = 0; id < Session.sym_count && count < max; id++) {
+        deep_symbol_t *sym = &Session.sym[id];
+        if (sym->source == NULL || (dirty_only && !sym->dirty)) {
+            continue;
+        }
+        defs[count].id = id;
+        defs[count].version = sym->version;
+        defs[count].len = strlen (sym->source) + 1;
+        count++;
+    }
+    repl_unlock ();
+    return count;
+}
+
+/*
+ * copy the current source of def into buf and refresh its version and len,
+ * return len ('\0' included). nothing is copied if buf is too small.
+ */
+int deep_repl_copy_def (deep_repl_def_t *def, char *buf, int size) {
+    if (def == NULL) {
+        return DEEP_FAIL;
+    }
+    repl_lock ();
+    if (def->id < 0 || def->id >= Session.sym_count || Session.sym[def->id].source == NULL) {
+        repl_unlock ();
+        return DEEP_FAIL;
+    }
+    deep_symbol_t *sym = &Session.sym[def->id];
+    def->version = sym->version;
+    def->len = strlen (sym->source) + 1;
+    if (buf != NULL && def->len <= size) {
+        memcpy (buf, sym->source, def->len);
+    }
+    repl_unlock ();
+    return def->len;
+}
+
+/*
+ * the copy of def is on flash, clear its dirty flag unless it changed since.
+ * a recompile also bumps the version, which only costs one extra save.
+ */
+void deep_repl_mark_saved (const deep_repl_def_t *def) {
+    repl_lock ();
+    deep_symbol_t *sym = &Session.sym[def->id];
+    if (sym->dirty && sym->version == def->version) {
+        sym->dirty = 0;
+        Session.dirty--;
+    }
+    repl_unlock ();
+}
+
+/* load a saved definition without output */
+int deep_repl_restore (const char *source) {
+    if (source == NULL) {
+        return DEEP_FAIL;
+    }
+    repl_lock ();
+    int ret = repl_define (source, true);
+    repl_unlock ();
+    return ret;
+}
@@ -0,0 +1,68 @@
+/*
+Date: 2026/10/19
+Description: deeplang repl session
+             every input line is compiled against one persistent symbol table,
+             definitions (let/fun) stay resident and a redefinition only
+             invalidates the definitions that depend on it.
+*/
+
+#ifndef _DEEP_REPL_H
+#define _DEEP_REPL_H
+
+#define DEEP_SYM_MAX       512   /* interned identifiers, power of 2 */
+#define DEEP_SYM_NAME_POOL 4096
+#define DEEP_SYM_EDGE_MAX  1024  /* dependency edges */
+
+#define DEEP_SYM_UNDEF     0x00  /* referenced, never defined */
+#define DEEP_SYM_VALID     0x01
+#define DEEP_SYM_STALE     0x02  /* a dependency was redefined */
+#define DEEP_SYM_KEYWORD   0x03
+#define DEEP_SYM_BUSY      0x04  /* stale, queued for recompile */
+
+typedef struct deep_symbol {
+    const char *name;       /* interned in session name pool */
+    char *source;           /* resident definition */
+    short dependents;       /* head of edge list, -1 if none */
+    short missing;          /* first undefined symbol reachable from source, -1 if none */
+    unsigned short version; /* bumped on every (re)compile */
+    unsigned char state;
+    unsigned char dirty;    /* changed since last snapshot */
+} deep_symbol_t;
+
+typedef struct deep_sym_edge {
+    short sym;              /* dependent symbol */
+    unsigned short version; /* dependent version the edge was made with */
+    short next;
+} deep_sym_edge_t;
+
+typedef struct deep_repl_session {
+    deep_symbol_t sym[DEEP_SYM_MAX];
+    short hash[DEEP_SYM_MAX * 2];
+    int sym_count;
+    char names[DEEP_SYM_NAME_POOL];
+    int names_used;
+    deep_sym_edge_t edge[DEEP_SYM_EDGE_MAX];
+    short edge_free;
+    int defs;
+    int dirty;
+    int last_us;
+    int max_us;
+} deep_repl_session_t;
+
+/* a definition as seen by the snapshot writer */
+typedef struct deep_repl_def {
+    short id;
+    unsigned short version; /* symbol version when listed or copied */
+    unsigned short len;     /* source length, '\0' included */
+} deep_repl_def_t;
+
+void deep_repl_init (void);
+int deep_repl_eval (const char *line);
+void deep_repl_stat (void);
+int deep_repl_dirty (void);
+int deep_repl_list_defs (int dirty_only, deep_repl_def_t *defs, int max);
+int deep_repl_copy_def (deep_repl_def_t *def, char *buf, int size);
+void deep_repl_mark_saved (const deep_repl_def_t *def);
+int deep_repl_restore (const char *source);
+
+#endif
@@ -0,0 +1,275 @@
+/*
+Date: 2026/10/19
+Description: vm state snapshot for warm restarts
+             restore is one read of the image plus a quiet recompile of every
+             definition. a torn append (reset while saving) ends the image at
+             the last good record and the next save rewrites it in full.
+             a full save is renamed over the image, a reset after the old
+             image is removed leaves only the complete temp file, which is
+             restored instead.
+*/
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "deep_common.h"
+#include "dstp.h"
+#include "deep_event.h"
+#include "deep_repl.h"
+#include "deep_snapshot.h"
+
+#define SOURCE_BUF     (128)   /* repl lines fit, longer sources are allocated */
+
+static deep_event_t SnapshotTimer = {0};
+static deep_event_t SnapshotClear = {0};
+static bool SnapshotFull = true;     /* next save rewrites the whole image */
+static long SnapshotSize = 0;        /* image size on flash */
+static long SnapshotLive = 0;        /* image size the current definitions need */
+static deep_repl_def_t SnapshotDefs[DEEP_SYM_MAX];   /* definitions of the save in progress */
+static char SnapshotSource[SOURCE_BUF];
+
+static unsigned char snapshot_sum (const unsigned char *head, const unsigned char *data, int len) {
+    unsigned int sum = head[0] + head[1] + head[2];
+    for (int i = 0; i < len; i++) {
+        sum += data[i];
+    }
+    return sum & 0xFF;
+}
+
+static int snapshot_write_rec (FILE *f, const char *source, int len) {
+    unsigned char head[DEEP_SNAPSHOT_REC_SIZE];
+    head[0] = len & 0xFF;
+    head[1] = (len >> 8) & 0xFF;
+    head[2] = DEEP_SNAPSHOT_DEF;
+    head[3] = snapshot_sum (head, (const unsigned char *) source, len);
+    if (fwrite (head, 1, DEEP_SNAPSHOT_REC_SIZE, f) != DEEP_SNAPSHOT_REC_SIZE
+        || fwrite (source, 1, len, f) != (size_t) len) {
+        return DEEP_FAIL;
+    }
+    SnapshotSize += DEEP_SNAPSHOT_REC_SIZE + len;
+    return DEEP_OK;
+}
+
+/*
+ * write the first count entries of SnapshotDefs. each source is copied out
+ * under a short repl lock, the session stays usable while flash is written.
+ */
+static int snapshot_write_defs (FILE *f, int count) {
+    for (int i = 0; i < count; i++) {
+        deep_repl_def_t *def = &SnapshotDefs[i];
+        char *source = SnapshotSource;
+        int len = deep_repl_copy_def (def, source, SOURCE_BUF);
+        if (len > SOURCE_BUF) {
+            source = deep_malloc (len);
+            if (source == NULL || deep_repl_copy_def (def, source, len) != len) {
+                deep_free (source);
+                return DEEP_FAIL;
+            }
+        }
+        int ret = (len > 0) ? snapshot_write_rec (f, source, len) : DEEP_FAIL;
+        if (source != SnapshotSource) {
+            deep_free (source);
+        }
+        if (ret != DEEP_OK) {
+            return DEEP_FAIL;
+        }
+    }
+    return DEEP_OK;
+}
+
+/* the written definitions are on flash, a change made meanwhile stays dirty */
+static void snapshot_mark_saved (int count) {
+    for (int i = 0; i < count; i++) {
+        deep_repl_mark_saved (&SnapshotDefs[i]);
+    }
+}
+
+/* write every definition to a new image and swap it in */
+static int snapshot_save_full (void) {
+    FILE *f = fopen (DEEP_SNAPSHOT_TMP, "w");
+    if (f == NULL) {
+        deep_printf ("Failed to open %s for writing\r\n", DEEP_SNAPSHOT_TMP);
+        return DEEP_FAIL;
+    }
+    unsigned char head[DEEP_SNAPSHOT_HEAD_SIZE] = {0};
+    memcpy (head, DEEP_SNAPSHOT_MAGIC, 4);
+    head[4] = DEEP_SNAPSHOT_VERSION;
+    SnapshotSize = DEEP_SNAPSHOT_HEAD_SIZE;
+    int count = deep_repl_list_defs (0, SnapshotDefs, DEEP_SYM_MAX);
+    int ret = DEEP_OK;
+    if (fwrite (head, 1, DEEP_SNAPSHOT_HEAD_SIZE, f) != DEEP_SNAPSHOT_HEAD_SIZE
+        || snapshot_write_defs (f, count) != DEEP_OK) {
+        ret = DEEP_FAIL;
+    }
+    if (fclose (f) != 0) {
+        ret = DEEP_FAIL;
+    }
+    if (ret != DEEP_OK) {
+        remove (DEEP_SNAPSHOT_TMP);
+        return DEEP_FAIL;
+    }
+    remove (DEEP_SNAPSHOT_FILE);
+    if (rename (DEEP_SNAPSHOT_TMP, DEEP_SNAPSHOT_FILE) != 0) {
+        return DEEP_FAIL;
+    }
+    snapshot_mark_saved (count);
+    SnapshotLive = SnapshotSize;
+    SnapshotFull = false;
+    return DEEP_OK;
+}
+
+/* append the count dirty definitions listed in SnapshotDefs */
+static int snapshot_save_dirty (int count) {
+    FILE *f = fopen (DEEP_SNAPSHOT_FILE, "a");
+    if (f == NULL) {
+        return DEEP_FAIL;
+    }
+    int ret = snapshot_write_defs (f, count);
+    if (fclose (f) != 0 || ret != DEEP_OK) {
+        return DEEP_FAIL;
+    }
+    snapshot_mark_saved (count);
+    return DEEP_OK;
+}
+
+/* image bytes of the first count entries of SnapshotDefs */
+static long snapshot_bytes (int count) {
+    long size = 0;
+    for (int i = 0; i < count; i++) {
+        size += DEEP_SNAPSHOT_REC_SIZE + SnapshotDefs[i].len;
+    }
+    return size;
+}
+
+/* not reentrant, runs from the event task only */
+int deep_snapshot_save (void) {
+    int ret = DEEP_OK;
+    SnapshotLive = DEEP_SNAPSHOT_HEAD_SIZE + snapshot_bytes (deep_repl_list_defs (0, SnapshotDefs, DEEP_SYM_MAX));
+    if (SnapshotLive > DEEP_SNAPSHOT_MAX) {
+        deep_printf ("snapshot: %ld bytes of definitions, over %d\r\n", SnapshotLive, DEEP_SNAPSHOT_MAX);
+        return DEEP_FAIL;
+    }
+    int count = deep_repl_list_defs (1, SnapshotDefs, DEEP_SYM_MAX);
+    long append = snapshot_bytes (count);
+    long superseded = SnapshotSize + append - SnapshotLive;
+    /*
+     * compact when superseded records would outweigh the live ones (and
+     * take over 4 KB), or when the append would pass DEEP_SNAPSHOT_COMPACT
+     */
+    if (SnapshotFull || SnapshotSize + append > DEEP_SNAPSHOT_COMPACT
+        || (superseded > SnapshotLive && superseded > 4096)) {
+        ret = snapshot_save_full ();
+    } else if (count > 0) {
+        ret = snapshot_save_dirty (count);
+    }
+    if (ret != DEEP_OK) {
+        SnapshotFull = true;
+    }
+    return ret;
+}
+
+static void snapshot_timer_cb (void *arg) {
+    if (deep_repl_dirty () > 0 || SnapshotFull) {
+        deep_snapshot_save ();
+    }
+}
+
+/* save on the next tick, then flush dirty state periodically from the event manager */
+void deep_snapshot_start (void) {
+    unsigned int period = DEEP_SNAPSHOT_PERIOD_MS / portTICK_PERIOD_MS;
+    deep_event_timer_start (&SnapshotTimer, 1, period, snapshot_timer_cb, NULL);
+}
+
+/* offset just past the last good record of image */
+static long snapshot_valid (const unsigned char *image, long size) {
+    long pos = DEEP_SNAPSHOT_HEAD_SIZE;
+    while (pos + DEEP_SNAPSHOT_REC_SIZE <= size) {
+        const unsigned char *head = &image[pos];
+        int len = head[0] | (head[1] << 8);
+        const unsigned char *data = head + DEEP_SNAPSHOT_REC_SIZE;
+        if (pos + DEEP_SNAPSHOT_REC_SIZE + len > size || len == 0
+            || head[3] != snapshot_sum (head, data, len) || data[len - 1] != '\0') {
+            break;
+        }
+        pos += DEEP_SNAPSHOT_REC_SIZE + len;
+    }
+    return pos;
+}
+
+/* load the image into a fresh repl session, return restored definitions or DEEP_FAIL on cold start */
+int deep_snapshot_restore (void) {
+    int64_t start = esp_timer_get_time ();
+    deep_repl_init ();
+    SnapshotFull = true;
+    bool tmp = false;
+    FILE *f = fopen (DEEP_SNAPSHOT_FILE, "r");
+    if (f == NULL) {
+        /* reset between removing the old image and renaming the new one */
+        f = fopen (DEEP_SNAPSHOT_TMP, "r");
+        tmp = true;
+    }
+    if (f == NULL) {
+        return DEEP_FAIL;
+    }
+    fseek (f, 0, SEEK_END);
+    long size = ftell (f);
+    fseek (f, 0, SEEK_SET);
+    if (size < DEEP_SNAPSHOT_HEAD_SIZE || size > DEEP_SNAPSHOT_MAX) {
+        fclose (f);
+        return DEEP_FAIL;
+    }
+    unsigned char *image = deep_malloc (size);
+    if (image == NULL) {
+        fclose (f);
+        return DEEP_FAIL;
+    }
+    if (fread (image, 1, size, f) != (size_t) size) {
+        fclose (f);
+        deep_free (image);
+        return DEEP_FAIL;
+    }
+    fclose (f);
+    if (memcmp (image, DEEP_SNAPSHOT_MAGIC, 4) != 0 || image[4] != DEEP_SNAPSHOT_VERSION) {
+        deep_printf ("snapshot version mismatch, cold start\r\n");
+        deep_free (image);
+        return DEEP_FAIL;
+    }
+    long end = snapshot_valid (image, size);
+    if (tmp && end != size) {
+        /* the new image was never finished, there is nothing to restore */
+        deep_free (image);
+        return DEEP_FAIL;
+    }
+    int count = 0;
+    long pos = DEEP_SNAPSHOT_HEAD_SIZE;
+    while (pos < end) {
+        unsigned char *head = &image[pos];
+        int len = head[0] | (head[1] << 8);
+        if (head[2] == DEEP_SNAPSHOT_DEF && deep_repl_restore ((const char *) head + DEEP_SNAPSHOT_REC_SIZE) == DEEP_OK) {
+            count++;
+        }
+        pos += DEEP_SNAPSHOT_REC_SIZE + len;
+    }
+    deep_free (image);
+    /* a clean image keeps growing by appends, a torn or unrenamed one is rewritten */
+    SnapshotSize = size;
+    SnapshotFull = (end != size) || tmp;
+    deep_printf ("warm restart: %d records restored in %d us\r\n", count, (int) (esp_timer_get_time () - start));
+    return count;
+}
+
+static void snapshot_clear_cb (void *arg) {
+    deep_event_timer_stop (&SnapshotTimer);
+    remove (DEEP_SNAPSHOT_FILE);
+    remove (DEEP_SNAPSHOT_TMP);
+    SnapshotSize = 0;
+    SnapshotLive = 0;
+    SnapshotFull = true;
+}
+
+/* drop the image and stop saving until deep_snapshot_start, next boot is a cold start */
+void deep_snapshot_clear (void) {
+    deep_event_post (DEEP_EVENT_QUEUE_STORAGE, &SnapshotClear, snapshot_clear_cb, NULL);
+}
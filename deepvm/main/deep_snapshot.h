@@ -0,0 +1,34 @@
+/*
+Date: 2026/10/19
+Description: vm state snapshot for warm restarts
+             the repl session definitions are kept in an append-only image
+             on spiffs. a full image is written once, after that only dirty
+             definitions are appended, later records override earlier ones.
+             the image is rewritten once superseded records outweigh the
+             live ones or an append would pass DEEP_SNAPSHOT_COMPACT.
+             file: "DSNP" version flags reserved[2], then records
+             record: len[2] type[1] sum[1] data[len], little endian,
+                     sum is the low byte of the sum of len, type and data
+*/
+
+#ifndef _DEEP_SNAPSHOT_H
+#define _DEEP_SNAPSHOT_H
+
+#define DEEP_SNAPSHOT_FILE      "/spiffs/deepvm.snp"
+#define DEEP_SNAPSHOT_TMP       "/spiffs/deepvm.snp.tmp"
+#define DEEP_SNAPSHOT_MAGIC     "DSNP"
+#define DEEP_SNAPSHOT_VERSION   1
+#define DEEP_SNAPSHOT_HEAD_SIZE 8
+#define DEEP_SNAPSHOT_REC_SIZE  4       /* record header without data */
+#define DEEP_SNAPSHOT_MAX       (64 * 1024)     /* 512 full repl lines take 8 + 512 * 124 bytes */
+#define DEEP_SNAPSHOT_COMPACT   (56 * 1024)     /* an append past this rewrites the image instead */
+#define DEEP_SNAPSHOT_PERIOD_MS (5000)  /* dirty state is flushed this often */
+
+#define DEEP_SNAPSHOT_DEF       0x01    /* repl definition source, '\0' included */
+
+int deep_snapshot_restore (void);
+void deep_snapshot_start (void);
+int deep_snapshot_save (void);
+void deep_snapshot_clear (void);
+
+#endif
@@ -0,0 +1,151 @@
+/*
+Date: 2026/10/19
+Description: uart trace capture
+             records are written into the ring in file format, so saving is
+             a plain copy. capture copies the record header and data with
+             memcpy (split in two where the ring wraps) under a spinlock.
+*/
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "deep_common.h"
+#include "dstp.h"
+#include "deep_trace.h"
+
+static unsigned char TraceRing[DEEP_TRACE_RING_SIZE] = {0};
+static int TraceHead = 0;     /* next write position */
+static int TraceTail = 0;     /* oldest record */
+static int TraceUsed = 0;
+static int TraceRecords = 0;
+static int TraceDropped = 0;
+static int TraceMode = DSTP_ASCII_MODE;
+static bool TraceWrapped = false;
+static volatile bool TraceOn = false;
+static int TraceDirs = DEEP_TRACE_RX;    /* directions being captured */
+static int64_t TraceStart = 0;
+static portMUX_TYPE TraceLock = portMUX_INITIALIZER_UNLOCKED;
+
+static void trace_put (const unsigned char *data, int len) {
+    int first = DEEP_TRACE_RING_SIZE - TraceHead;
+    if (first > len) {
+        first = len;
+    }
+    memcpy (&TraceRing[TraceHead], data, first);
+    memcpy (TraceRing, data + first, len - first);
+    TraceHead = (TraceHead + len) % DEEP_TRACE_RING_SIZE;
+}
+
+/* drop the oldest record to make room */
+static void trace_drop (void) {
+    int pos = (TraceTail + 5) % DEEP_TRACE_RING_SIZE;
+    int len = TraceRing[pos] | (TraceRing[(pos + 1) % DEEP_TRACE_RING_SIZE] << 8);
+    TraceTail = (TraceTail + DEEP_TRACE_REC_SIZE + len) % DEEP_TRACE_RING_SIZE;
+    TraceUsed -= DEEP_TRACE_REC_SIZE + len;
+    TraceRecords--;
+    TraceDropped++;
+    TraceWrapped = true;
+}
+
+/* dirs is a mask of DEEP_TRACE_RX/TX, replay only needs rx */
+void deep_trace_start (int dirs) {
+    portENTER_CRITICAL (&TraceLock);
+    TraceHead = 0;
+    TraceTail = 0;
+    TraceUsed = 0;
+    TraceRecords = 0;
+    TraceDropped = 0;
+    TraceWrapped = false;
+    TraceMode = deep_dstp_get_mode ();
+    TraceStart = esp_timer_get_time ();
+    TraceDirs = dirs;
+    TraceOn = true;
+    portEXIT_CRITICAL (&TraceLock);
+}
+
+void deep_trace_stop (void) {
+    TraceOn = false;
+}
+
+void deep_trace_record (int dir, const unsigned char *data, int len) {
+    if (!TraceOn || (dir & TraceDirs) == 0 || data == NULL || len <= 0) {
+        return;
+    }
+    int need = DEEP_TRACE_REC_SIZE + len;
+    if (len > 0xFFFF || need > DEEP_TRACE_RING_SIZE) {
+        TraceDropped++;
+        return;
+    }
+    unsigned char head[DEEP_TRACE_REC_SIZE];
+    portENTER_CRITICAL (&TraceLock);
+    if (!TraceOn) {
+        portEXIT_CRITICAL (&TraceLock);
+        return;
+    }
+    /* stamped under the lock so records stay in time order across tasks */
+    unsigned int time = (unsigned int) (esp_timer_get_time () - TraceStart);
+    head[0] = time & 0xFF;
+    head[1] = (time >> 8) & 0xFF;
+    head[2] = (time >> 16) & 0xFF;
+    head[3] = (time >> 24) & 0xFF;
+    head[4] = dir;
+    head[5] = len & 0xFF;
+    head[6] = (len >> 8) & 0xFF;
+    while (TraceUsed + need > DEEP_TRACE_RING_SIZE) {
+        trace_drop ();
+    }
+    trace_put (head, DEEP_TRACE_REC_SIZE);
+    trace_put (data, len);
+    TraceUsed += need;
+    TraceRecords++;
+    portEXIT_CRITICAL (&TraceLock);
+}
+
+/* write the ring to a file, capture is paused while saving */
+int deep_trace_save (const char *path) {
+    bool on = TraceOn;
+    portENTER_CRITICAL (&TraceLock);
+    TraceOn = false;
+    portEXIT_CRITICAL (&TraceLock);
+    FILE *f = fopen (path, "w");
+    if (f == NULL) {
+        deep_printf ("Failed to open %s for writing\r\n", path);
+        TraceOn = on;
+        return DEEP_FAIL;
+    }
+    unsigned char head[DEEP_TRACE_HEAD_SIZE] = {0};
+    memcpy (head, DEEP_TRACE_MAGIC, 4);
+    head[4] = DEEP_TRACE_VERSION;
+    head[5] = TraceMode;
+    head[6] = TraceWrapped ? DEEP_TRACE_WRAPPED : 0;
+    int first = DEEP_TRACE_RING_SIZE - TraceTail;
+    if (first > TraceUsed) {
+        first = TraceUsed;
+    }
+    int ret = DEEP_OK;
+    if (fwrite (head, 1, DEEP_TRACE_HEAD_SIZE, f) != DEEP_TRACE_HEAD_SIZE
+        || fwrite (&TraceRing[TraceTail], 1, first, f) != (size_t) first
+        || fwrite (TraceRing, 1, TraceUsed - first, f) != (size_t) (TraceUsed - first)) {
+        ret = DEEP_FAIL;
+    }
+    if (fclose (f) != 0) {
+        ret = DEEP_FAIL;
+    }
+    if (ret != DEEP_OK) {
+        deep_printf ("Failed to write %s\r\n", path);
+        remove (path);
+        TraceOn = on;
+        return DEEP_FAIL;
+    }
+    deep_printf ("trace saved to %s, %d records, %d bytes\r\n", path, TraceRecords, TraceUsed);
+    TraceOn = on;
+    return DEEP_OK;
+}
+
+void deep_trace_stat (void) {
+    deep_printf ("trace %s%s, %d records, %d/%d bytes, %d dropped\r\n",
+                 TraceOn ? "on" : "off", (TraceOn && (TraceDirs & DEEP_TRACE_TX)) ? " (rx, tx)" : "",
+                 TraceRecords, TraceUsed, DEEP_TRACE_RING_SIZE, TraceDropped);
+}
@@ -0,0 +1,34 @@
+/*
+Date: 2026/10/19
+Description: uart trace capture
+             timestamped rx/tx chunks are kept in a ram ring (oldest records
+             are dropped when full) and can be saved to spiffs for replay on
+             the pc with tools/dstp_replay.
+             file: "DTRC" version mode flags, then records
+             record: time_us[4] dir[1] len[2] data[len], little endian,
+                     time_us is relative to capture start
+*/
+
+#ifndef _DEEP_TRACE_H
+#define _DEEP_TRACE_H
+
+#define DEEP_TRACE_RING_SIZE   (8 * 1024)
+#define DEEP_TRACE_FILE        "/spiffs/trace.dtr"
+#define DEEP_TRACE_BOOT        0        /* 1: start rx capture in app_main */
+
+#define DEEP_TRACE_MAGIC       "DTRC"
+#define DEEP_TRACE_VERSION     1
+#define DEEP_TRACE_HEAD_SIZE   8
+#define DEEP_TRACE_REC_SIZE    7        /* record header without data */
+#define DEEP_TRACE_WRAPPED     0x01     /* header flag, oldest records dropped */
+
+#define DEEP_TRACE_RX          0x01
+#define DEEP_TRACE_TX          0x02     /* every deep_printf, only for debugging */
+
+void deep_trace_start (int dirs);
+void deep_trace_stop (void);
+void deep_trace_record (int dir, const unsigned char *data, int len);
+int deep_trace_save (const char *path);
+void deep_trace_stat (void);
+
+#endif
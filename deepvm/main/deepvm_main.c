@@ -17,6 +17,9 @@ Description: deepvm is a language VM for deeplang(www.deeplang.org).
 #include "esp_spiffs.h"
 #include "deep_common.h"
 #include "dstp.h"
+#include "deep_event.h"
+#include "deep_trace.h"
+#include "deep_snapshot.h"
 
 
 #ifdef CONFIG_IDF_TARGET_ESP32
@@ -118,6 +121,7 @@ static void deepvm_uart_process_task(void *arg)
         // Read data from the UART
         int len = uart_read_bytes(UART_NUM_0, data, BUF_SIZE, 20 / portTICK_RATE_MS);
         if(len > 0) {
+            deep_trace_record (DEEP_TRACE_RX, data, len);
             for (int i = 0; i < len; i++) {
                 deep_dstp_datain (data[i]);
             }
@@ -133,11 +137,18 @@ static void deepvm_dstp_task (void *arg) {
     }
 }
 
+static void deepvm_event_task (void *arg) {
+    while (1) {
+        deep_event_process ();
+    }
+}
+
 void app_main(void)
 {
     uart0Init ();
     spiffsInit();
     testSpiffs();
+    deep_snapshot_restore ();
     /* Print chip information */
     /* conflict with spiffs*/
     // esp_chip_info_t chip_info;
@@ -155,6 +166,12 @@ void app_main(void)
     /* Deepvm start */
     deep_printf ("Deepvm for deeplang 0.1\r\n");
     deep_printf ("Deepvm includes parser, wasm vm, event manager, uart file manager\r\n");
+#if DEEP_TRACE_BOOT
+    deep_trace_start (DEEP_TRACE_RX);
+#endif
+    deep_event_init ();
+    deep_snapshot_start ();
+    xTaskCreate(deepvm_event_task, "deepvm_event_task", 4096, NULL, 11, NULL);
     xTaskCreate(deepvm_uart_process_task, "deepvm_uart_process_task", 4096, NULL, 10, NULL);
     xTaskCreate(deepvm_dstp_task, "deepvm_dstp_task", 4096, NULL, 12, NULL);
 }
\ No newline at end of file
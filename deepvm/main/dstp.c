@@ -14,6 +14,10 @@ Description: DSTP, deepvm serial transfer protocol
 #include "freertos/task.h"
 #include "deep_common.h"
 #include "dstp.h"
+#include "deep_event.h"
+#include "deep_repl.h"
+#include "deep_trace.h"
+#include "deep_snapshot.h"
 #define RING_BUF_SIZE 512
 #define DSTP_DUMMY 0xFF
 #define CMD_STR_LEN (120)
@@ -24,6 +28,7 @@ static volatile int DataOutIndex = 0;
 static volatile int ProcessMode = DSTP_ASCII_MODE;
 static volatile int ProcessState = DSTP_FRAME_HEAD; /* only for DSTP_FRAME_MODE */
 static dstp_frame_t dstp = {0};
+static dstp_frame_hook_t FrameHook = NULL;
 
 static unsigned char get_dstp_sum (dstp_frame_t *frame) {
     if (frame == NULL) {
@@ -113,6 +118,13 @@ static void reset_process_state (void) {
     memset ((unsigned char *) &dstp, 0x00, sizeof(dstp));
 }
 
+static void process_frame_end (int result) {
+    if (FrameHook != NULL) {
+        FrameHook (DSTP_STATE_END, result, dstp.cmd);
+    }
+    reset_process_state ();
+}
+
 static int process_read_data (unsigned char *data, int len, int timeout_tick) {
     if (data == NULL) {
         return DEEP_FAIL;
@@ -192,13 +204,16 @@ static void process_head_handle (void) {
     dstp.head[0] = DSTP_MAGIC_HEAD0;
     dstp.head[1] = DSTP_MAGIC_HEAD1;
     set_process_state (DSTP_FRAME_CMD);
+    if (FrameHook != NULL) {
+        FrameHook (DSTP_STATE_START, DEEP_OK, 0);
+    }
 }
 
 static void process_cmd_handle (void) {
     unsigned char data = 0;
     int ret = process_read_data (&data, 1, 100);
     if (ret != DEEP_OK) {
-        reset_process_state ();
+        process_frame_end (ret);
         return;
     }
     debug ("cmd=0x%02x\r\n", data);
@@ -210,7 +225,7 @@ static void process_len_handle (void){
     unsigned char data[2] = {0};
     int ret = process_read_data (data, 2, 10);
     if (ret != DEEP_OK) {
-        reset_process_state ();
+        process_frame_end (ret);
         return;
     }
     dstp.len = data[0] * 256 + data[1];
@@ -221,12 +236,13 @@ static void process_len_handle (void){
 static void process_payload_handle (void) {
     unsigned char *data = deep_malloc (dstp.len);
     if (data == NULL) {
-        reset_process_state ();
+        process_frame_end (DEEP_FAIL);
         return;
     }
     int ret = process_read_data (data, dstp.len, 100);
     if (ret != DEEP_OK) {
-        reset_process_state ();
+        deep_free (data);
+        process_frame_end (ret);
         return;
     }
     dstp.payload = data;
@@ -238,22 +254,22 @@ static void process_tail_handle (void) {
     unsigned char data = 0;
     int ret = process_read_data (&data, 1, 0);
     if (ret != DEEP_OK) {
-        reset_process_state ();
+        process_frame_end (ret);
         return;
     }
     debug ("tail0=0x%02X\r\n", data);
     if (data != DSTP_MAGIC_TAIL0) {
-        reset_process_state ();
+        process_frame_end (DEEP_FAIL);
         return;
     }
     ret = process_read_data (&data, 1, 0);
     if (ret != DEEP_OK) {
-        reset_process_state ();
+        process_frame_end (ret);
         return;
     }
     debug ("tail1=0x%02X\r\n", data);
     if (data != DSTP_MAGIC_TAIL1) {
-        reset_process_state ();
+        process_frame_end (DEEP_FAIL);
         return;
     }
     dstp.tail[0] = DSTP_MAGIC_TAIL0;
@@ -265,7 +281,7 @@ static void process_sum_handle (void) {
     unsigned char data = 0;
     int ret = process_read_data (&data, 1, 0);
     if (ret != DEEP_OK) {
-        reset_process_state ();
+        process_frame_end (ret);
         return;
     }
     dstp.sum = data;
@@ -273,7 +289,7 @@ static void process_sum_handle (void) {
     debug ("sum=0x%02X\r\n",sum);
     if (sum != dstp.sum) {
         debug ("DSTP frame sum error,sum=0x%02X,sum\'=0x%02X\r\n", dstp.sum, sum);
-        reset_process_state ();
+        process_frame_end (DEEP_FAIL);
         return;
     }
     /* DSTP frame done */
@@ -293,6 +309,9 @@ static void process_sum_handle (void) {
             break;
     }
     /* DSTP cmd handle done */
+    if (FrameHook != NULL) {
+        FrameHook (DSTP_STATE_END, DEEP_OK, dstp.cmd);
+    }
     process_send_ack ();
 }
 
@@ -303,11 +322,15 @@ static void process_ascii_mode_with_repl (void) {
     while (1) {
         if (ring_buf_empty()) {
             vTaskDelay (1);
+            continue;
         }
         char ch = ring_buf_dataout ();
         if (ch == '\r' || ch == '\n') {
             break;
         }
+        if (i >= CMD_STR_LEN - 1) {
+            continue;
+        }
         deep_printf ("%c", ch);
         buf[i++] = ch;
     }
@@ -319,6 +342,10 @@ static void process_ascii_mode_with_repl (void) {
         deep_printf (":version   deeplang version\r\n");
         deep_printf (":memstat   memory status info\r\n");
         deep_printf (":mode      dstp mode\r\n");
+        deep_printf (":evbench   event manager benchmark\r\n");
+        deep_printf (":symbols   repl session symbol table\r\n");
+        deep_printf (":trace     uart rx trace on|on tx|off|save|stat\r\n");
+        deep_printf (":snapshot  save vm snapshot now, clear to drop it\r\n");
     } else if (memcmp (":exit", buf, strlen (":exit")) == 0) {
         set_process_mode (DSTP_FRAME_MODE);
         set_process_state (DSTP_FRAME_HEAD);
@@ -327,10 +354,28 @@ static void process_ascii_mode_with_repl (void) {
         deep_printf ("deeplang v0.1\r\n");
     } else if (memcmp (":memstat", buf, strlen (":memstat")) == 0) {
         deep_printf ("Total 100KB, Left 10KB\r\n");
+    } else if (memcmp (":evbench", buf, strlen (":evbench")) == 0) {
+        deep_event_bench (2000);
+    } else if (memcmp (":symbols", buf, strlen (":symbols")) == 0) {
+        deep_repl_stat ();
+    } else if (memcmp (":trace on tx", buf, strlen (":trace on tx")) == 0) {
+        deep_trace_start (DEEP_TRACE_RX | DEEP_TRACE_TX);
+    } else if (memcmp (":trace on", buf, strlen (":trace on")) == 0) {
+        deep_trace_start (DEEP_TRACE_RX);
+    } else if (memcmp (":trace off", buf, strlen (":trace off")) == 0) {
+        deep_trace_stop ();
+    } else if (memcmp (":trace save", buf, strlen (":trace save")) == 0) {
+        deep_trace_save (DEEP_TRACE_FILE);
+    } else if (memcmp (":trace", buf, strlen (":trace")) == 0) {
+        deep_trace_stat ();
+    } else if (memcmp (":snapshot clear", buf, strlen (":snapshot clear")) == 0) {
+        deep_snapshot_clear ();
+    } else if (memcmp (":snapshot", buf, strlen (":snapshot")) == 0) {
+        deep_snapshot_start ();
     } else if (memcmp (":mode", buf, strlen (":mode")) == 0) {
         deep_printf ("ascii mode\r\n");
     } else {
-        deep_printf ("deep_eval (\"%s\")\r\n", buf);
+        deep_repl_eval (buf);
     }
 }
 
@@ -338,6 +383,19 @@ void deep_dstp_datain (unsigned char data) {
     return ring_buf_datain (data);
 }
 
+int deep_dstp_get_mode (void) {
+    return get_process_mode ();
+}
+
+void deep_dstp_set_mode (int mode) {
+    set_process_mode (mode);
+    reset_process_state ();
+}
+
+void deep_dstp_set_hook (dstp_frame_hook_t hook) {
+    FrameHook = hook;
+}
+
 void deep_dstp_process (void) {
     if (ring_buf_empty ()) {
         vTaskDelay (5);
@@ -49,8 +49,15 @@ typedef struct dstp_frame {
     unsigned char sum;
 } dstp_frame_t;
 
+/* event is DSTP_STATE_START when a frame head is matched, DSTP_STATE_END
+   when the frame is done, result is DEEP_OK, DEEP_FAIL or DEEP_TIMEOUT */
+typedef void (*dstp_frame_hook_t) (int event, int result, unsigned char cmd);
+
 void deep_dstp_datain (unsigned char data);
 void deep_dstp_process (void);
+int deep_dstp_get_mode (void);
+void deep_dstp_set_mode (int mode);
+void deep_dstp_set_hook (dstp_frame_hook_t hook);
 
 
 #endif
@@ -0,0 +1,99 @@
+/*
+Date: 2026/10/19
+Description: deepvm benchmarks on the pc
+             runs the same code as the device against the host shims,
+             time is the host monotonic clock.
+usage: bench event [timers]
+       bench repl [definitions]
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "deep_common.h"
+#include "dstp.h"
+#include "deep_event.h"
+#include "deep_repl.h"
+
+static int Quiet = 0;   /* drop device output while timing */
+
+int64_t host_now_us (void) {
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+void host_delay (TickType_t ticks) {
+    usleep ((useconds_t) ticks * portTICK_PERIOD_MS * 1000);
+}
+
+int host_tx (const char *buf, int len) {
+    return Quiet ? len : (int) fwrite (buf, 1, len, stdout);
+}
+
+static int64_t repl_time (const char *line) {
+    int64_t start = host_now_us ();
+    Quiet = 1;
+    int ret = deep_repl_eval (line);
+    Quiet = 0;
+    int64_t us = host_now_us () - start;
+    if (ret != DEEP_OK) {
+        printf ("repl bench: \"%s\" failed\n", line);
+    }
+    return us;
+}
+
+/*
+ * worst case for the session: a chain d0 <- d1 <- ... <- dN-1, so
+ * redefining d0 invalidates every definition and using dN-1 recompiles all.
+ */
+static void repl_bench (int count) {
+    char line[64];
+    int64_t define_max = 0;
+    deep_repl_init ();
+    int64_t start = host_now_us ();
+    for (int i = 0; i < count; i++) {
+        if (i == 0) {
+            snprintf (line, sizeof (line), "let d0 = 1");
+        } else {
+            snprintf (line, sizeof (line), "fun d%d(x) = d%d(x) + x", i, i - 1);
+        }
+        int64_t us = repl_time (line);
+        if (us > define_max) {
+            define_max = us;
+        }
+    }
+    int64_t define_all = host_now_us () - start;
+    snprintf (line, sizeof (line), "d%d(1)", count - 1);
+    int64_t eval = repl_time (line);
+    int64_t redefine = repl_time ("let d0 = 2");
+    int64_t refresh = repl_time (line);
+    int64_t again = repl_time (line);
+    printf ("repl bench: %d definitions, define all %d us (max %d us), eval %d us\n",
+            count, (int) define_all, (int) define_max, (int) eval);
+    printf ("repl bench: redefine root %d us, eval after redefine %d us, eval again %d us\n",
+            (int) redefine, (int) refresh, (int) again);
+}
+
+static void usage (const char *name) {
+    fprintf (stderr, "usage: %s event [timers]\n       %s repl [definitions]\n", name, name);
+}
+
+int main (int argc, char *argv[]) {
+    if (argc < 2) {
+        usage (argv[0]);
+        return 1;
+    }
+    if (strcmp (argv[1], "event") == 0) {
+        deep_event_bench (argc > 2 ? atoi (argv[2]) : 10000);
+    } else if (strcmp (argv[1], "repl") == 0) {
+        repl_bench (argc > 2 ? atoi (argv[2]) : 400);
+    } else {
+        usage (argv[0]);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,225 @@
+/*
+Date: 2026/10/19
+Description: DSTP trace replay on the pc
+             feeds the rx records of a trace captured with ":trace save"
+             through deep_dstp_datain/deep_dstp_process and reports every
+             frame's outcome and latency.
+             time is virtual: the clock only moves when dstp calls vTaskDelay,
+             so timeouts behave as on the device and replay runs as fast as
+             possible. -r also sleeps to keep the original wall clock timing.
+usage: dstp_replay [-r] [-v] [-m ascii|frame] [-i idle_ms] trace.dtr
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "deep_common.h"
+#include "dstp.h"
+#include "deep_trace.h"
+
+static unsigned char *Trace = NULL;
+static long TraceSize = 0;
+static long TracePos = DEEP_TRACE_HEAD_SIZE;
+static int64_t TraceTime = 0;        /* absolute time of last parsed record */
+static unsigned int TraceLast = 0;   /* raw 32 bit time of last parsed record */
+static int64_t NowUs = 0;
+static int64_t IdleUs = 2000 * 1000;
+static int RealTime = 0;
+static int Verbose = 0;
+static long RxBytes = 0;
+static long TxRecorded = 0;
+static long TxReplayed = 0;
+
+static int Frames = 0;
+static int FramesOk = 0;
+static int FramesFail = 0;
+static int FramesTimeout = 0;
+static int64_t FrameStartUs = 0;
+static int64_t FrameStartCpu = 0;
+static int64_t LatencyMax = 0;
+static int64_t LatencySum = 0;
+static int64_t CpuMax = 0;
+static int64_t CpuSum = 0;
+
+static int64_t cpu_now_us (void) {
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+int64_t host_now_us (void) {
+    return NowUs;
+}
+
+int host_tx (const char *buf, int len) {
+    TxReplayed += len;
+    if (Verbose) {
+        fwrite (buf, 1, len, stdout);
+    }
+    return len;
+}
+
+static void replay_report (void) {
+    printf ("\nframes %d, ok %d, fail %d, timeout %d\n", Frames, FramesOk, FramesFail, FramesTimeout);
+    if (Frames > 0) {
+        printf ("latency avg %.3f ms, max %.3f ms\n",
+                LatencySum / 1000.0 / Frames, LatencyMax / 1000.0);
+        printf ("cpu avg %lld us, max %lld us\n", (long long) (CpuSum / Frames), (long long) CpuMax);
+    }
+    printf ("rx %ld bytes, tx recorded %ld bytes, tx replayed %ld bytes\n", RxBytes, TxRecorded, TxReplayed);
+}
+
+/* feed every rx record due at NowUs, return 0 when the trace is used up */
+static int replay_feed (void) {
+    while (TracePos + DEEP_TRACE_REC_SIZE <= TraceSize) {
+        unsigned char *rec = &Trace[TracePos];
+        unsigned int time = rec[0] | (rec[1] << 8) | (rec[2] << 16) | ((unsigned int) rec[3] << 24);
+        int dir = rec[4];
+        int len = rec[5] | (rec[6] << 8);
+        /* records are in time order, a step back would only come from a damaged trace */
+        int32_t delta = (int32_t) (time - TraceLast);
+        int64_t at = TraceTime + (delta > 0 ? delta : 0);
+        if (at > NowUs) {
+            return 1;
+        }
+        if (TracePos + DEEP_TRACE_REC_SIZE + len > TraceSize) {
+            fprintf (stderr, "truncated record at offset %ld\n", TracePos);
+            break;
+        }
+        if (dir == DEEP_TRACE_RX) {
+            for (int i = 0; i < len; i++) {
+                deep_dstp_datain (rec[DEEP_TRACE_REC_SIZE + i]);
+            }
+            RxBytes += len;
+        } else {
+            TxRecorded += len;
+        }
+        TraceTime = at;
+        TraceLast = time;
+        TracePos += DEEP_TRACE_REC_SIZE + len;
+    }
+    TracePos = TraceSize;
+    return 0;
+}
+
+/* vTaskDelay of the shim: advance the clock, deliver due bytes, stop when idle at the end */
+void host_delay (TickType_t ticks) {
+    if (ticks == 0) {
+        ticks = 1;
+    }
+    int64_t step = (int64_t) ticks * portTICK_PERIOD_MS * 1000;
+    NowUs += step;
+    if (RealTime) {
+        usleep (step);
+    }
+    if (replay_feed () == 0 && NowUs > TraceTime + IdleUs) {
+        replay_report ();
+        exit (0);
+    }
+}
+
+static void replay_frame_hook (int event, int result, unsigned char cmd) {
+    if (event == DSTP_STATE_START) {
+        FrameStartUs = NowUs;
+        FrameStartCpu = cpu_now_us ();
+        return;
+    }
+    int64_t latency = NowUs - FrameStartUs;
+    int64_t cpu = cpu_now_us () - FrameStartCpu;
+    const char *outcome = "ok";
+    Frames++;
+    if (result == DEEP_OK) {
+        FramesOk++;
+    } else if (result == DEEP_TIMEOUT) {
+        FramesTimeout++;
+        outcome = "timeout";
+    } else {
+        FramesFail++;
+        outcome = "fail";
+    }
+    LatencySum += latency;
+    CpuSum += cpu;
+    if (latency > LatencyMax) {
+        LatencyMax = latency;
+    }
+    if (cpu > CpuMax) {
+        CpuMax = cpu;
+    }
+    printf ("frame %d at %.3f ms: cmd 0x%02X %s, latency %.3f ms, cpu %lld us\n",
+            Frames, FrameStartUs / 1000.0, cmd, outcome, latency / 1000.0, (long long) cpu);
+}
+
+static int replay_load (const char *path) {
+    FILE *f = fopen (path, "rb");
+    if (f == NULL) {
+        fprintf (stderr, "Failed to open %s\n", path);
+        return DEEP_FAIL;
+    }
+    fseek (f, 0, SEEK_END);
+    TraceSize = ftell (f);
+    fseek (f, 0, SEEK_SET);
+    Trace = malloc (TraceSize > 0 ? TraceSize : 1);
+    if (Trace == NULL || fread (Trace, 1, TraceSize, f) != (size_t) TraceSize) {
+        fprintf (stderr, "Failed to read %s\n", path);
+        fclose (f);
+        return DEEP_FAIL;
+    }
+    fclose (f);
+    if (TraceSize < DEEP_TRACE_HEAD_SIZE || memcmp (Trace, DEEP_TRACE_MAGIC, 4) != 0) {
+        fprintf (stderr, "%s is not a deepvm trace\n", path);
+        return DEEP_FAIL;
+    }
+    if (Trace[4] != DEEP_TRACE_VERSION) {
+        fprintf (stderr, "unsupported trace version %d\n", Trace[4]);
+        return DEEP_FAIL;
+    }
+    if (Trace[6] & DEEP_TRACE_WRAPPED) {
+        fprintf (stderr, "warning: trace ring wrapped, dstp mode at start may be wrong\n");
+    }
+    /* start the clock at the first record */
+    if (TraceSize >= DEEP_TRACE_HEAD_SIZE + DEEP_TRACE_REC_SIZE) {
+        unsigned char *rec = &Trace[DEEP_TRACE_HEAD_SIZE];
+        TraceLast = rec[0] | (rec[1] << 8) | (rec[2] << 16) | ((unsigned int) rec[3] << 24);
+    }
+    return DEEP_OK;
+}
+
+int main (int argc, char *argv[]) {
+    int mode = 0;
+    int opt = 0;
+    while ((opt = getopt (argc, argv, "rvm:i:")) != -1) {
+        switch (opt) {
+            case 'r':
+                RealTime = 1;
+                break;
+            case 'v':
+                Verbose = 1;
+                break;
+            case 'm':
+                mode = (strcmp (optarg, "frame") == 0) ? DSTP_FRAME_MODE : DSTP_ASCII_MODE;
+                break;
+            case 'i':
+                IdleUs = (int64_t) atoi (optarg) * 1000;
+                break;
+            default:
+                fprintf (stderr, "usage: %s [-r] [-v] [-m ascii|frame] [-i idle_ms] trace.dtr\n", argv[0]);
+                return 1;
+        }
+    }
+    if (optind >= argc) {
+        fprintf (stderr, "usage: %s [-r] [-v] [-m ascii|frame] [-i idle_ms] trace.dtr\n", argv[0]);
+        return 1;
+    }
+    if (replay_load (argv[optind]) != DEEP_OK) {
+        return 1;
+    }
+    deep_dstp_set_mode (mode != 0 ? mode : Trace[5]);
+    deep_dstp_set_hook (replay_frame_hook);
+    while (1) {
+        deep_dstp_process ();
+    }
+    return 0;
+}
@@ -0,0 +1,8 @@
+/*
+Description: host shim for tools
+*/
+
+#ifndef _SHIM_GPIO_H
+#define _SHIM_GPIO_H
+
+#endif
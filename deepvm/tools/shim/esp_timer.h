@@ -0,0 +1,16 @@
+/*
+Description: host shim for tools
+*/
+
+#ifndef _SHIM_ESP_TIMER_H
+#define _SHIM_ESP_TIMER_H
+
+#include <stdint.h>
+
+int64_t host_now_us (void);
+
+static inline int64_t esp_timer_get_time (void) {
+    return host_now_us ();
+}
+
+#endif
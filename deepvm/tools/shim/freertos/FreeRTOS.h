@@ -0,0 +1,26 @@
+/*
+Description: host shim for tools, just enough FreeRTOS for deepvm/main
+*/
+
+#ifndef _SHIM_FREERTOS_H
+#define _SHIM_FREERTOS_H
+
+#include <stdint.h>
+
+#define configTICK_RATE_HZ   100
+#define portTICK_PERIOD_MS   (1000 / configTICK_RATE_HZ)
+#define portTICK_RATE_MS     portTICK_PERIOD_MS
+
+typedef uint32_t TickType_t;
+typedef int portMUX_TYPE;
+
+#define pdFALSE          0
+#define pdTRUE           1
+#define portMAX_DELAY    ((TickType_t) 0xFFFFFFFF)
+
+/* replay is single threaded */
+#define portMUX_INITIALIZER_UNLOCKED  0
+#define portENTER_CRITICAL(mux)       ((void) (mux))
+#define portEXIT_CRITICAL(mux)        ((void) (mux))
+
+#endif
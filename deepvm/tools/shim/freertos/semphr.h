@@ -0,0 +1,16 @@
+/*
+Description: host shim for tools, host programs are single threaded
+*/
+
+#ifndef _SHIM_SEMPHR_H
+#define _SHIM_SEMPHR_H
+
+#include "freertos/FreeRTOS.h"
+
+typedef void *SemaphoreHandle_t;
+
+#define xSemaphoreCreateMutex()     ((SemaphoreHandle_t) 1)
+#define xSemaphoreTake(sem, ticks)  ((void) (sem), (void) (ticks))
+#define xSemaphoreGive(sem)         ((void) (sem))
+
+#endif
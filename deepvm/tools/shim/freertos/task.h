@@ -0,0 +1,38 @@
+/*
+Description: host shim for tools, time comes from the host program (host_now_us)
+*/
+
+#ifndef _SHIM_TASK_H
+#define _SHIM_TASK_H
+
+#include "freertos/FreeRTOS.h"
+
+int64_t host_now_us (void);
+void host_delay (TickType_t ticks);
+
+static inline TickType_t xTaskGetTickCount (void) {
+    return (TickType_t) (host_now_us () / (portTICK_PERIOD_MS * 1000));
+}
+
+static inline void vTaskDelay (TickType_t ticks) {
+    host_delay (ticks);
+}
+
+/* single task, a notification can never arrive while blocked */
+typedef void *TaskHandle_t;
+
+static inline TaskHandle_t xTaskGetCurrentTaskHandle (void) {
+    return (TaskHandle_t) 1;
+}
+
+static inline void xTaskNotifyGive (TaskHandle_t task) {
+    (void) task;
+}
+
+static inline uint32_t ulTaskNotifyTake (int clear, TickType_t ticks) {
+    (void) clear;
+    host_delay ((ticks == portMAX_DELAY) ? 1 : ticks);
+    return 0;
+}
+
+#endif